@@ -3,17 +3,53 @@
  * Acknowledgement: Nathan Hagerdorn, for the original version of the component generator.
  * Copyright: Ohio Northern University, 2023.
  * License: GPL v3
- * Usage: Change the size parameters (n, m) below to the desired length of the multiplier and multiplicand respectively. Build and run the program.
+ * Usage: Change DEFAULT_N below to the desired length of the multiplier (m follows n). Build and run the program.
+ *   --stats                    Print wall time, bytes emitted, throughput and peak RSS for each generator phase.
+ *   --bench [report]           Run every generator for n = 64 ... 65536 and write a .csv or .json report
+ *                              (default: generator_bench.csv). Each phase is repeated until a sample lasts at least
+ *                              BENCH_MIN_SAMPLE and timed as the median of BENCH_REPS samples taken across the sweep.
+ *                              Generated text is counted but not written, so no files are created and disk speed does
+ *                              not skew results. A fixed calibration workload is timed alongside the generators.
+ *   --baseline <report>        With --bench, compare against a previous .csv or .json report and exit with status 1
+ *   --threshold <percent>      if any phase got slower than the threshold (default: 25%) and by more than
+ *                              BENCH_MIN_DELTA, after scaling the baseline by the change in calibration time.
+ *   --baud <rate>              Baud rate of the generated streaming container (default: DEFAULT_BAUD_RATE).
+ *   --sampling-factor <f>      Receiver oversampling factor of the streaming container (default: DEFAULT_SAMPLING_FACTOR).
  */ 
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <sstream>
 #include <string>
 #include <bitset>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
 #define FILE_ENDING "_ngen.vhd"
+#define DEFAULT_N 256
+
+// Serial link parameters of the streaming container, matching the mk8 apex defaults
+#define CLK_FREQ 100000000
+#define DEFAULT_BAUD_RATE 9600
+#define DEFAULT_SAMPLING_FACTOR 4
+
+// Benchmark sweep and regression settings
+#define BENCH_MIN_N 64
+#define BENCH_MAX_N 65536
+#define BENCH_REPS 7
+#define BENCH_DEFAULT_THRESHOLD 25.0 // percent
+#define BENCH_MIN_SAMPLE 0.02        // seconds; short phases are repeated until a sample lasts this long
+#define BENCH_MIN_DELTA 0.0001       // seconds; slowdowns smaller than this are timer and scheduling noise
 
 // Prototypes
 void genEncoder();
@@ -22,7 +58,16 @@ void genDecoder();
 void genPartialDecoder(std::ofstream &output, std::string name, 
                        int max, int upper_range, int lower_range);
 void genAlgorithm();
+void genContainer();
+void genStreamApex();
 void printLibraries(std::ofstream &output);
+void openOutput(std::ofstream &output, const std::string &filename);
+void closeOutput(std::ofstream &output, const std::string &filename);
+void setParameters(int size);
+void runPhase(const std::string &name, void (*gen)());
+long peakRssKilobytes();
+void printStatsToTerminal();
+int runBenchmark(const std::string &reportFile, const std::string &baselineFile, double threshold);
 std::string intToBinaryString(int i);
 void printParametersToTerminal();
 void printBitVectorToTerminal(std::vector<bool> bv);
@@ -31,14 +76,39 @@ void decrement(std::vector<bool> &bv);
 bool isEmpty(std::vector<bool> bv);
 
 
+// Output State
+bool quiet = false;   // suppress per-file progress messages (set while benchmarking)
+long bytesEmitted = 0; // bytes written by the current phase, accumulated in closeOutput()
+bool discardOutput = false; // count generated text without writing it (set while benchmarking)
+
+// Stream buffer that drops everything written to it, keeping only the byte count for tellp()
+class CountingBuffer : public std::streambuf {
+public:
+  long count = 0;
+protected:
+  int overflow(int c) override {
+    if (c != traits_type::eof()) count++;
+    return traits_type::not_eof(c);
+  }
+  std::streamsize xsputn(const char *, std::streamsize length) override {
+    count += length;
+    return length;
+  }
+  pos_type seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode) override {
+    return (offset == 0 && dir == std::ios_base::cur) ? pos_type(count) : pos_type(off_type(-1));
+  }
+};
+CountingBuffer countingBuffer;
+
 // Size Parameters
 
 /* 
 Multiplier Length n
 Must be a power of 2
 Input to Priority Encoder, XOR, NOR
+Defaults to DEFAULT_N; benchmark mode (--bench) sweeps it via setParameters()
 */
-const int n = 256;
+int n;
 
 /*
 Multiplicand Length m
@@ -46,22 +116,37 @@ Must be a power of 2
 Input to Barrel Shifter
 */
 // using square multipliers for now, but can change this to something else
-const int m = n; 
+int m; 
 
 /*
 Base 2 Logarithm of input length n
 Output of Priority Encoder
 Input to Decoder, Barrel Shifter
 */
-const int log2n = log2(n);
+int log2n;
 
 // q is the least power of 2 greater than sqrt(n)
-const int q = pow(2, (ceil(log2(sqrt(n)))));
-const int log2q = log2(q);
+int q;
+int log2q;
 
 // k is n/q
-const int k = n/q;
-const int log2k = log2(k);
+int k;
+int log2k;
+
+// Serial link parameters for genContainer()
+int baudRate = DEFAULT_BAUD_RATE;
+int samplingFactor = DEFAULT_SAMPLING_FACTOR;
+
+// Derive all size parameters from the multiplier length
+void setParameters(int size) {
+  n = size;
+  m = n;
+  log2n = log2(n);
+  q = pow(2, (ceil(log2(sqrt(n)))));
+  log2q = log2(q);
+  k = n/q;
+  log2k = log2(k);
+}
 
 void printParametersToTerminal() {
   std::cout << "Parameters: \n" 
@@ -91,23 +176,342 @@ void printLibraries(std::ofstream &output) {
   << "use IEEE.std_logic_unsigned.all;\n\n";
 }
 
-int main(void) {
-  printParametersToTerminal();
-  genEncoder();
-  genBarrelShifter();
-  genDecoder();
-  genAlgorithm();
+// Open a generated file, reporting progress unless running quietly
+void openOutput(std::ofstream &output, const std::string &filename) {
+  if (!quiet) std::cout << "Creating " << filename << std::endl;
+  if (discardOutput) {
+    countingBuffer.count = 0;
+    output.std::ostream::rdbuf(&countingBuffer);
+  }
+  else output.open(filename);
+}
+
+// Close a generated file, recording how many bytes were written to it
+void closeOutput(std::ofstream &output, const std::string &filename) {
+  bytesEmitted += output.tellp();
+  output.close();
+  if (!quiet) std::cout << "Created " << filename << std::endl;
+}
+
+//
+// Instrumentation
+//
+
+struct PhaseStats {
+  std::string name; // generator phase, e.g. "encoder"
+  int n;            // multiplier length the phase was run for
+  double seconds;   // wall time
+  long bytes;       // bytes emitted to the generated file
+  long peakRssKb;   // process peak resident set size after the phase
+};
+
+std::vector<PhaseStats> phaseStats;
+
+// Process-wide high-water mark, so sweeps should run in increasing n
+long peakRssKilobytes() {
+#if defined(__APPLE__)
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024; // reported in bytes on macOS
+#elif defined(__unix__)
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss; // reported in kilobytes on Linux
+#else
   return 0;
+#endif
+}
+
+// Run a single generator, recording its wall time, output size and memory
+void runPhase(const std::string &name, void (*gen)()) {
+  bytesEmitted = 0;
+  auto begin = std::chrono::steady_clock::now();
+  gen();
+  auto end = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(end - begin).count();
+  phaseStats.push_back({name, n, seconds, bytesEmitted, peakRssKilobytes()});
+}
+
+double throughputMBps(const PhaseStats &s) {
+  return s.seconds > 0 ? s.bytes / s.seconds / 1e6 : 0;
+}
+
+void printStatsToTerminal() {
+  std::cout << "Generator Statistics: \n"
+            << std::left << std::setw(16) << "phase" << std::right
+            << std::setw(8) << "n"
+            << std::setw(14) << "time (ms)"
+            << std::setw(14) << "bytes"
+            << std::setw(12) << "MB/s"
+            << std::setw(16) << "peak RSS (KB)" << std::endl;
+  for (const PhaseStats &s : phaseStats) {
+    std::cout << std::left << std::setw(16) << s.name << std::right
+              << std::setw(8) << s.n
+              << std::setw(14) << std::fixed << std::setprecision(3) << s.seconds * 1000
+              << std::setw(14) << s.bytes
+              << std::setw(12) << std::setprecision(1) << throughputMBps(s)
+              << std::setw(16) << s.peakRssKb << std::endl;
+  }
+}
+
+void writeReport(const std::string &reportFile) {
+  std::ofstream report(reportFile);
+  bool json = reportFile.size() >= 5 && reportFile.compare(reportFile.size() - 5, 5, ".json") == 0;
+  report << std::setprecision(9);
+  if (json) {
+    report << "[\n";
+    for (size_t i = 0; i < phaseStats.size(); i++) {
+      const PhaseStats &s = phaseStats[i];
+      report << "  {\"phase\": \"" << s.name << "\", \"n\": " << s.n
+             << ", \"seconds\": " << s.seconds << ", \"bytes\": " << s.bytes
+             << ", \"mb_per_second\": " << throughputMBps(s)
+             << ", \"peak_rss_kb\": " << s.peakRssKb << "}"
+             << (i + 1 < phaseStats.size() ? ",\n" : "\n");
+    }
+    report << "]\n";
+  } else {
+    report << "phase,n,seconds,bytes,mb_per_second,peak_rss_kb\n";
+    for (const PhaseStats &s : phaseStats) {
+      report << s.name << "," << s.n << "," << s.seconds << "," << s.bytes << ","
+             << throughputMBps(s) << "," << s.peakRssKb << "\n";
+    }
+  }
+  std::cout << "Wrote " << reportFile << std::endl;
+}
+
+// Parse a whole field as a number, rejecting empty or trailing text
+bool parseField(const std::string &field, double &value) {
+  char *end;
+  value = strtod(field.c_str(), &end);
+  return !field.empty() && *end == '\0';
 }
 
+// Extract the value of "key" from one line of a JSON report written by writeReport()
+bool jsonField(const std::string &line, const std::string &key, std::string &value) {
+  size_t pos = line.find("\"" + key + "\"");
+  if (pos == std::string::npos || (pos = line.find(':', pos)) == std::string::npos) return false;
+  pos = line.find_first_not_of(' ', pos + 1);
+  if (pos == std::string::npos) return false;
+  size_t end;
+  if (line[pos] == '"') end = line.find('"', ++pos);
+  else end = line.find_first_of(",}", pos);
+  if (end == std::string::npos) return false;
+  value = line.substr(pos, end - pos);
+  return true;
+}
+
+// Read a CSV or JSON report from a previous run into (phase, n) -> seconds
+bool readBaseline(const std::string &baselineFile, std::map<std::pair<std::string, int>, double> &previous) {
+  std::ifstream baseline(baselineFile);
+  if (!baseline) {
+    std::cerr << "Could not open baseline " << baselineFile << std::endl;
+    return false;
+  }
+  std::string line;
+  bool json = false, first = true;
+  for (int lineNumber = 1; std::getline(baseline, line); lineNumber++) {
+    size_t start = line.find_first_not_of(" \t\r");
+    if (start == std::string::npos) continue;
+    std::string name, size, seconds;
+    if (first) {
+      first = false;
+      json = line[start] == '[';
+      if (json || line.compare(start, 6, "phase,") == 0) continue; // opening bracket or CSV header
+      std::cerr << baselineFile << ": not a report written by --bench" << std::endl;
+      return false;
+    }
+    if (json) {
+      if (line[start] == ']') continue;
+      if (!jsonField(line, "phase", name) || !jsonField(line, "n", size) || !jsonField(line, "seconds", seconds))
+        name.clear();
+    } else {
+      std::stringstream ss(line);
+      if (!std::getline(ss, name, ',') || !std::getline(ss, size, ',') || !std::getline(ss, seconds, ','))
+        name.clear();
+    }
+    double sizeValue, secondsValue;
+    if (name.empty() || !parseField(size, sizeValue) || !parseField(seconds, secondsValue) || secondsValue <= 0) {
+      std::cerr << baselineFile << ":" << lineNumber << ": malformed report row" << std::endl;
+      return false;
+    }
+    previous[{name, (int) sizeValue}] = secondsValue;
+  }
+  if (previous.empty()) {
+    std::cerr << baselineFile << ": no report rows" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Compare against a previous report, returns the number of regressions. Baseline times are
+// scaled by the ratio of the calibration phases, so a run on a slower or busier machine is
+// not reported as a regression of every phase.
+int checkBaseline(const std::map<std::pair<std::string, int>, double> &previous, double threshold) {
+  double scale = 1.0;
+  auto calibration = previous.find({"calibration", 0});
+  if (calibration != previous.end() && !phaseStats.empty() && phaseStats[0].name == "calibration") {
+    scale = phaseStats[0].seconds / calibration->second;
+    std::cout << "Machine speed relative to baseline: " << std::fixed << std::setprecision(2)
+              << 1.0 / scale << "x (baseline times scaled by " << scale << ")" << std::endl;
+  }
+  int regressions = 0;
+  for (const PhaseStats &s : phaseStats) {
+    auto it = previous.find({s.name, s.n});
+    if (it == previous.end() || s.name == "calibration") continue;
+    double expected = it->second * scale;
+    double change = (s.seconds / expected - 1.0) * 100.0;
+    if (change > threshold && s.seconds - expected > BENCH_MIN_DELTA) {
+      std::cout << std::fixed << std::setprecision(3)
+                << "REGRESSION: " << s.name << " (n = " << s.n << ") took "
+                << s.seconds * 1000 << " ms, baseline " << expected * 1000
+                << " ms (+" << std::setprecision(1) << change << "%)" << std::endl;
+      regressions++;
+    }
+  }
+  std::cout << std::setprecision(1) << regressions << " regression(s) over " << threshold << "% threshold and "
+            << BENCH_MIN_DELTA * 1000 << " ms" << std::endl;
+  return regressions;
+}
+
+// Time one benchmark sample of a generator, repeating it until the sample lasts at least
+// BENCH_MIN_SAMPLE so that sub-millisecond phases are measured reliably. Returns seconds per run.
+double benchSample(void (*gen)()) {
+  int runs = 0;
+  double elapsed;
+  auto begin = std::chrono::steady_clock::now();
+  do {
+    bytesEmitted = 0;
+    gen();
+    runs++;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  } while (elapsed < BENCH_MIN_SAMPLE);
+  return elapsed / runs;
+}
+
+// Fixed reference workload in the style of the generators, timed alongside them so that
+// reports can be compared relative to the speed of the machine at the time of each run
+void genCalibration() {
+  std::ofstream output;
+  openOutput(output, "calibration");
+  std::vector<bool> bits(1 << 16);
+  for (int i = 0; i < (1 << 12); i++) {
+    bits[(i * 7919) & 0xffff] = !bits[i & 0xffff];
+    output << "  signal s_" << i << ": std_logic_vector(" << (i & 63) << " downto 0) := \""
+           << intToBinaryString((i & 255) + 1) << "\"; -- " << bits[i & 0xffff] << "\n";
+  }
+  closeOutput(output, "calibration");
+}
+
+// Sweep every generator over n = BENCH_MIN_N ... BENCH_MAX_N
+int runBenchmark(const std::string &reportFile, const std::string &baselineFile, double threshold) {
+  struct { const char *name; void (*gen)(); } phases[] = {
+    {"encoder", genEncoder},
+    {"barrel_shifter", genBarrelShifter},
+    {"decoder", genDecoder},
+    {"algorithm", genAlgorithm},
+    {"container", genContainer},
+    {"stream_apex", genStreamApex}
+  };
+
+  // read the baseline first so a bad one fails before the sweep
+  std::map<std::pair<std::string, int>, double> previous;
+  if (!baselineFile.empty() && !readBaseline(baselineFile, previous)) return 2;
+
+  // time generation only; file system writes would dominate the short phases
+  quiet = true;
+  discardOutput = true;
+  bytesEmitted = 0;
+  genCalibration();
+  phaseStats.push_back({"calibration", 0, 0, bytesEmitted, peakRssKilobytes()});
+  for (int size = BENCH_MIN_N; size <= BENCH_MAX_N; size *= 2) {
+    setParameters(size);
+    for (auto &phase : phases) {
+      bytesEmitted = 0;
+      phase.gen(); // warm up and record bytes emitted
+      phaseStats.push_back({phase.name, n, 0, bytesEmitted, peakRssKilobytes()});
+    }
+  }
+
+  // sample the whole sweep BENCH_REPS times and keep the median of each phase, so a slow
+  // stretch on a shared machine lands in a few samples of every phase instead of all of one
+  std::vector<std::vector<double>> samples(phaseStats.size());
+  for (int rep = 0; rep < BENCH_REPS; rep++) {
+    size_t i = 1;
+    for (int size = BENCH_MIN_N; size <= BENCH_MAX_N; size *= 2) {
+      samples[0].push_back(benchSample(genCalibration));
+      setParameters(size);
+      for (auto &phase : phases) samples[i++].push_back(benchSample(phase.gen));
+    }
+  }
+  for (size_t i = 0; i < phaseStats.size(); i++) {
+    std::sort(samples[i].begin(), samples[i].end());
+    phaseStats[i].seconds = samples[i][samples[i].size() / 2];
+  }
+  discardOutput = false;
+
+  printStatsToTerminal();
+  writeReport(reportFile);
+  if (!baselineFile.empty() && checkBaseline(previous, threshold) > 0) return 1;
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  bool stats = false, bench = false;
+  std::string reportFile = "generator_bench.csv", baselineFile;
+  double threshold = BENCH_DEFAULT_THRESHOLD;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--stats") == 0) stats = true;
+    else if (strcmp(argv[i], "--bench") == 0) {
+      bench = true;
+      if (i + 1 < argc && argv[i + 1][0] != '-') reportFile = argv[++i];
+    }
+    else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baselineFile = argv[++i];
+    else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+      if (!parseField(argv[++i], threshold) || threshold < 0) {
+        std::cerr << "Invalid threshold " << argv[i] << ", expected a non-negative percentage" << std::endl;
+        return 2;
+      }
+    }
+    else if (strcmp(argv[i], "--baud") == 0 && i + 1 < argc) baudRate = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--sampling-factor") == 0 && i + 1 < argc) samplingFactor = atoi(argv[++i]);
+    else {
+      std::cerr << "Unknown argument: " << argv[i] << std::endl;
+      return 2;
+    }
+  }
+
+  if (baudRate <= 0 || samplingFactor <= 0) {
+    std::cerr << "Baud rate and sampling factor must be positive" << std::endl;
+    return 2;
+  }
+  // rx_module divides the clock by baud * sampling factor and needs at least a 1-bit counter
+  if (CLK_FREQ / ((long) baudRate * samplingFactor) < 2) {
+    std::cerr << "Baud rate " << baudRate << " with sampling factor " << samplingFactor
+              << " is too fast for a " << CLK_FREQ << " Hz clock" << std::endl;
+    return 2;
+  }
+
+  if (bench) return runBenchmark(reportFile, baselineFile, threshold);
+
+  setParameters(DEFAULT_N);
+  printParametersToTerminal();
+  runPhase("encoder", genEncoder);
+  runPhase("barrel_shifter", genBarrelShifter);
+  runPhase("decoder", genDecoder);
+  runPhase("algorithm", genAlgorithm);
+  runPhase("container", genContainer);
+  runPhase("stream_apex", genStreamApex);
+  if (stats) printStatsToTerminal();
+  return 0;
+}
 
 
 void genEncoder() {
   std::ofstream output;
   std::string entityName = "priority_encoder_" + std::to_string(n);
 	std::string filename = entityName + FILE_ENDING;
-  std::cout << "Creating " << filename << std::endl;
-	output.open(filename);
+  openOutput(output, filename);
 
   printLibraries(output);
 
@@ -260,16 +664,14 @@ void genEncoder() {
 
   // End Component Logic
   output << "end;";
-  output.close();
-  std::cout << "Created " << filename << std::endl;
+  closeOutput(output, filename);
 }
 
 void genBarrelShifter() {
   std::ofstream output;
   std::string entityName = "barrel_shifter_" + std::to_string(n);
 	std::string filename = entityName + FILE_ENDING;
-  std::cout << "Creating " << filename << std::endl;
-	output.open(filename);
+  openOutput(output, filename);
 
   printLibraries(output);
 
@@ -393,16 +795,14 @@ void genBarrelShifter() {
   
   // End Component Logic
   output << "end;";
-  output.close();
-  std::cout << "Created " << filename << std::endl;
+  closeOutput(output, filename);
 }
 
 void genDecoder() {
   std::ofstream output;
   std::string entityName = "decoder_" + std::to_string(n);
 	std::string filename = entityName + FILE_ENDING;
-  std::cout << "Creating " << filename << std::endl;
-	output.open(filename);
+  openOutput(output, filename);
 
   printLibraries(output);
 
@@ -473,8 +873,7 @@ void genDecoder() {
 
   // End Component Logic
   output << "end;";
-  output.close();
-  std::cout << "Created " << filename << std::endl;
+  closeOutput(output, filename);
 }
 
 /// @brief Generates a small single level decoder
@@ -515,8 +914,7 @@ void genAlgorithm() {
   std::ofstream output;
   std::string entityName = "multiplier_" + std::to_string(n);
 	std::string filename = entityName + FILE_ENDING;
-  std::cout << "Creating " << filename << std::endl;
-	output.open(filename);
+  openOutput(output, filename);
 
   output << "library IEEE;\n"
   << "use IEEE.std_logic_1164.all;\n"
@@ -662,6 +1060,7 @@ void genAlgorithm() {
   << "      mr_reg <= (others => '1'); -- set all 1s initially to avoid premature done\n"
   << "      prod_reg <= (others => '0');\n"
   << "      done <= '0';\n"
+  << "      active <= '0'; -- allow the next start to load new operands\n"
   << "    elsif (clk'event and clk = '1') then\n"
   << "      done <= hw_done;\n"
   << "      if (start = '1' and active = '0') then\n"
@@ -677,8 +1076,497 @@ void genAlgorithm() {
 
   // End Component Logic
   output << "end;";
-  output.close();
-  std::cout << "Created " << filename << std::endl;
+  closeOutput(output, filename);
+}
+
+void genContainer() {
+  std::ofstream output;
+  std::string entityName = "stream_container_" + std::to_string(n);
+	std::string filename = entityName + FILE_ENDING;
+  openOutput(output, filename);
+
+  printLibraries(output);
+
+  //
+  // Entity
+  //
+
+  // Begin Entity
+  output << "entity " << entityName << " is" << std::endl;
+
+  // Generics
+  output
+  << "generic(\n"
+  << "  g_n:               integer := " << n << ";  -- Input (multiplier) length is n\n"
+  << "  g_m:               integer := " << m << ";  -- Input (multiplicand) length is m\n"
+  << "  g_bytes:           integer := " << (n + m) / 8 << ";  -- Bytes per operand and product frame, i.e., (n + m) / 8\n"
+  << "  g_clk_freq:        integer := " << CLK_FREQ << ";  -- Board clock (clk), which rx_module and tx_module are timed against\n"
+  << "  g_sampling_factor: integer := " << samplingFactor << ";  -- rx oversampling factor\n"
+  << "  g_baud_rate:       integer := " << baudRate << "\n"
+  << ");\n";
+
+  output
+  << "port(\n"
+  << "  clk: in std_logic; -- board clock for the serial link\n"
+  << "  clk_hw: in std_logic; -- multiplier clock, from the clocking wizard in stream_apex_N or tied to clk\n"
+  << "  reset: in std_logic;\n"
+  << "  switches: in std_logic_vector(15 downto 0); -- 15: sign of multiplier, 14: sign of multiplicand\n"
+  << "  input: in std_logic; -- serial in\n"
+  << "  output: out std_logic; -- serial out\n"
+  << "  leds: out std_logic_vector(15 downto 0) -- 15: overrun, 14: sign of product, 13-0: products computed\n"
+  << ");\n";
+
+  // End Entity
+  output << "end " << entityName << ";\n\n";
+
+  //
+  // Architecture
+  //
+
+  output << "architecture behavioral of " << entityName << " is\n\n";
+
+  // Explain the pipeline, since this replaces the receive/process/transmit sequence of the mk8 transceiver
+  output
+  << "  -- Frames use the mk8 transceiver format: g_bytes bytes, most significant byte first,\n"
+  << "  -- multiplier in the upper half of the operand frame. Operand i + 1 is received into one\n"
+  << "  -- operand buffer while operand i is multiplied out of the other, and product i - 1 is\n"
+  << "  -- transmitted from one result buffer while product i is written to the other, so sustained\n"
+  << "  -- throughput is one frame time per product as long as the multiplier is faster than the link.\n"
+  << "  -- The serial link runs on clk and the multiplier on clk_hw; only single-bit buffer toggles cross.\n"
+  << "  -- The host may have up to three frames in flight; a byte arriving while both operand buffers\n"
+  << "  -- are full is dropped and latches the overrun LED until reset.\n\n";
+
+  // Components
+  output
+  << "  component rx_module\n"
+  << "  generic(\n"
+  << "    G_byte_bits: integer;\n"
+  << "    G_clk_freq: integer;\n"
+  << "    G_sampling_factor: integer;\n"
+  << "    G_baud_rate: integer\n"
+  << "  );\n"
+  << "  port(\n"
+  << "    clk: in std_logic;\n"
+  << "    reset: in std_logic;\n"
+  << "    input: in std_logic;\n"
+  << "    data: out std_logic_vector(G_byte_bits - 1 downto 0);\n"
+  << "    idle: out std_logic;\n"
+  << "    receiving: out std_logic;\n"
+  << "    done: out std_logic\n"
+  << "  );\n"
+  << "  end component;\n\n";
+
+  output
+  << "  component tx_module\n"
+  << "  generic(\n"
+  << "    G_byte_bits: integer;\n"
+  << "    G_clk_freq: integer;\n"
+  << "    G_baud_rate: integer\n"
+  << "  );\n"
+  << "  port(\n"
+  << "    clk: in std_logic;\n"
+  << "    reset: in std_logic;\n"
+  << "    send: in std_logic;\n"
+  << "    data: in std_logic_vector(G_byte_bits - 1 downto 0);\n"
+  << "    ready: out std_logic;\n"
+  << "    output: out std_logic\n"
+  << "  );\n"
+  << "  end component;\n\n";
+
+  output
+  << "  component multiplier_" << n << "\n"
+  << "  port(\n"
+  << "    clk: in std_logic;\n"
+  << "    start: in std_logic;\n"
+  << "    reset: in std_logic;\n"
+  << "    mr: in std_logic_vector(g_n - 1 downto 0);\n"
+  << "    s_mr: in std_logic;\n"
+  << "    md: in std_logic_vector(g_m - 1 downto 0);\n"
+  << "    s_md: in std_logic;\n"
+  << "    prod: out std_logic_vector(g_n + g_m - 1 downto 0);\n"
+  << "    s_prod: out std_logic;\n"
+  << "    done: out std_logic\n"
+  << "  );\n"
+  << "  end component;\n\n";
+
+  output
+  << "  component synchronizer_2ff\n"
+  << "  port(\n"
+  << "    input: in std_logic;\n"
+  << "    dest_clk: in std_logic;\n"
+  << "    reset: in std_logic;\n"
+  << "    output: out std_logic\n"
+  << "  );\n"
+  << "  end component;\n\n";
+
+  // Buffers
+  output
+  << "  -- Ping-Pong Buffers\n"
+  << "  -- Each buffer has a fill toggle flipped by its writer and a release toggle flipped by its reader, so\n"
+  << "  -- every toggle has a single owner and crosses between clk and clk_hw through synchronizer_2ff.\n"
+  << "  -- A buffer is full while its two toggles differ. The frames themselves are not synchronized: a\n"
+  << "  -- buffer is only written while it is empty and only read while it is full, so it is stable\n"
+  << "  -- whenever the other domain sees it full.\n"
+  << "  type frame_buffer is array (0 to 1) of std_logic_vector(g_n + g_m - 1 downto 0);\n"
+  << "  signal op_buf: frame_buffer := (others => (others => '0')); -- written on clk\n"
+  << "  signal res_buf: frame_buffer := (others => (others => '0')); -- written on clk_hw\n"
+  << "  signal op_fill: std_logic_vector(1 downto 0) := \"00\"; -- toggled on clk\n"
+  << "  signal op_release: std_logic_vector(1 downto 0) := \"00\"; -- toggled on clk_hw\n"
+  << "  signal res_fill: std_logic_vector(1 downto 0) := \"00\"; -- toggled on clk_hw\n"
+  << "  signal res_release: std_logic_vector(1 downto 0) := \"00\"; -- toggled on clk\n"
+  << "  signal op_fill_hw, op_release_clk, res_fill_clk, res_release_hw: std_logic_vector(1 downto 0); -- synchronized\n"
+  << "  signal op_full, res_full: std_logic_vector(1 downto 0); -- as seen on clk\n"
+  << "  signal op_full_hw, res_full_hw: std_logic_vector(1 downto 0); -- as seen on clk_hw\n"
+  << "  signal rx_sel: integer range 0 to 1 := 0; -- operand buffer being received\n"
+  << "  signal mul_sel: integer range 0 to 1 := 0; -- operand/result buffer pair being multiplied\n"
+  << "  signal tx_sel: integer range 0 to 1 := 0; -- next result buffer to transmit\n\n";
+
+  // Receive Stage
+  output
+  << "  -- Receive Stage\n"
+  << "  signal rx_data: std_logic_vector(7 downto 0);\n"
+  << "  signal rx_done: std_logic;\n"
+  << "  signal rx_valid: std_logic := '0'; -- rx_module registers data one cycle after done\n"
+  << "  signal rx_count: integer range 0 to g_bytes - 1 := 0;\n"
+  << "  signal overrun: std_logic := '0';\n\n";
+
+  // Compute Stage
+  output
+  << "  -- Compute Stage\n"
+  << "  type mul_state_type is (MUL_IDLE, MUL_RUN);\n"
+  << "  signal mul_state: mul_state_type := MUL_IDLE;\n"
+  << "  signal mul_reset: std_logic;\n"
+  << "  signal mul_start: std_logic;\n"
+  << "  signal mul_done: std_logic;\n"
+  << "  signal mr: std_logic_vector(g_n - 1 downto 0);\n"
+  << "  signal md: std_logic_vector(g_m - 1 downto 0);\n"
+  << "  signal prod: std_logic_vector(g_n + g_m - 1 downto 0);\n"
+  << "  signal s_prod: std_logic;\n"
+  << "  signal products: std_logic_vector(13 downto 0) := (others => '0');\n\n";
+
+  // Transmit Stage
+  output
+  << "  -- Transmit Stage\n"
+  << "  type tx_state_type is (TX_IDLE, TX_LOAD, TX_SEND, TX_WAIT);\n"
+  << "  signal tx_state: tx_state_type := TX_IDLE;\n"
+  << "  signal tx_frame: std_logic_vector(g_n + g_m - 1 downto 0) := (others => '0'); -- copy of the result being sent\n"
+  << "  signal tx_data: std_logic_vector(7 downto 0) := (others => '0');\n"
+  << "  signal tx_send: std_logic;\n"
+  << "  signal tx_ready: std_logic;\n"
+  << "  signal tx_count: integer range 0 to g_bytes - 1 := 0;\n\n";
+
+  // Begin
+  output << "begin\n";
+
+  // Instantiate Components
+  output
+  << "  -- Instantiate Components\n"
+  << "  rx: rx_module\n"
+  << "  generic map(\n"
+  << "    G_byte_bits => 8,\n"
+  << "    G_clk_freq => g_clk_freq,\n"
+  << "    G_sampling_factor => g_sampling_factor,\n"
+  << "    G_baud_rate => g_baud_rate\n"
+  << "  )\n"
+  << "  port map(\n"
+  << "    clk => clk,\n"
+  << "    reset => reset,\n"
+  << "    input => input,\n"
+  << "    data => rx_data,\n"
+  << "    idle => open,\n"
+  << "    receiving => open,\n"
+  << "    done => rx_done\n"
+  << "  );\n\n"
+  << "  tx: tx_module\n"
+  << "  generic map(\n"
+  << "    G_byte_bits => 8,\n"
+  << "    G_clk_freq => g_clk_freq,\n"
+  << "    G_baud_rate => g_baud_rate\n"
+  << "  )\n"
+  << "  port map(\n"
+  << "    clk => clk,\n"
+  << "    reset => reset, -- unlike the mk8 transceiver, tx runs while rx is receiving (full duplex)\n"
+  << "    send => tx_send,\n"
+  << "    data => tx_data,\n"
+  << "    ready => tx_ready,\n"
+  << "    output => output\n"
+  << "  );\n\n"
+  << "  multiplier: multiplier_" << n << " port map(\n"
+  << "    clk => clk_hw,\n"
+  << "    start => mul_start,\n"
+  << "    reset => mul_reset,\n"
+  << "    mr => mr,\n"
+  << "    s_mr => switches(15),\n"
+  << "    md => md,\n"
+  << "    s_md => switches(14),\n"
+  << "    prod => prod,\n"
+  << "    s_prod => s_prod,\n"
+  << "    done => mul_done\n"
+  << "  );\n\n";
+
+  // Synchronize the buffer toggles, one pair of synchronizers per buffer and direction
+  output
+  << "  sync: for i in 0 to 1 generate\n"
+  << "    op_fill_syncr: synchronizer_2ff port map(\n"
+  << "      input => op_fill(i),\n"
+  << "      dest_clk => clk_hw,\n"
+  << "      reset => reset,\n"
+  << "      output => op_fill_hw(i)\n"
+  << "    );\n"
+  << "    op_release_syncr: synchronizer_2ff port map(\n"
+  << "      input => op_release(i),\n"
+  << "      dest_clk => clk,\n"
+  << "      reset => reset,\n"
+  << "      output => op_release_clk(i)\n"
+  << "    );\n"
+  << "    res_fill_syncr: synchronizer_2ff port map(\n"
+  << "      input => res_fill(i),\n"
+  << "      dest_clk => clk,\n"
+  << "      reset => reset,\n"
+  << "      output => res_fill_clk(i)\n"
+  << "    );\n"
+  << "    res_release_syncr: synchronizer_2ff port map(\n"
+  << "      input => res_release(i),\n"
+  << "      dest_clk => clk_hw,\n"
+  << "      reset => reset,\n"
+  << "      output => res_release_hw(i)\n"
+  << "    );\n"
+  << "  end generate;\n\n";
+
+  // Assigning Signals
+  output
+  << "  op_full <= op_fill xor op_release_clk;\n"
+  << "  res_full <= res_fill_clk xor res_release;\n"
+  << "  op_full_hw <= op_fill_hw xor op_release;\n"
+  << "  res_full_hw <= res_fill xor res_release_hw;\n"
+  << "  mr <= op_buf(mul_sel)(g_n + g_m - 1 downto g_m);\n"
+  << "  md <= op_buf(mul_sel)(g_m - 1 downto 0); -- must stay stable while multiplying\n"
+  << "  mul_reset <= '1' when (reset = '1' or mul_state = MUL_IDLE) else '0';\n"
+  << "  mul_start <= '1' when (mul_state = MUL_RUN) else '0';\n"
+  << "  tx_send <= '1' when (tx_state = TX_SEND) else '0';\n"
+  << "  leds <= overrun & s_prod & products;\n\n";
+
+  // Clock Sensitive Logic
+  // Receive and transmit run on the board clock, which rx_module and tx_module are timed against
+  output
+  << "  -- Receive and Transmit (clk)\n"
+  << "  process (clk, reset) begin\n"
+  << "    if (reset = '1') then\n"
+  << "      op_fill <= \"00\";\n"
+  << "      res_release <= \"00\";\n"
+  << "      rx_sel <= 0;\n"
+  << "      tx_sel <= 0;\n"
+  << "      rx_valid <= '0';\n"
+  << "      rx_count <= 0;\n"
+  << "      overrun <= '0';\n"
+  << "      tx_state <= TX_IDLE;\n"
+  << "      tx_data <= (others => '0');\n"
+  << "      tx_count <= 0;\n"
+  << "    elsif (clk'event and clk = '1') then\n"
+  << "      -- receive: shift each byte into the current operand buffer until the frame is complete\n"
+  << "      rx_valid <= rx_done;\n"
+  << "      if (rx_valid = '1') then\n"
+  << "        if (op_full(rx_sel) = '1') then\n"
+  << "          overrun <= '1';\n"
+  << "        else\n"
+  << "          op_buf(rx_sel) <= op_buf(rx_sel)(g_n + g_m - 9 downto 0) & rx_data;\n"
+  << "          if (rx_count = g_bytes - 1) then\n"
+  << "            op_fill(rx_sel) <= not op_fill(rx_sel);\n"
+  << "            rx_sel <= 1 - rx_sel;\n"
+  << "            rx_count <= 0;\n"
+  << "          else\n"
+  << "            rx_count <= rx_count + 1;\n"
+  << "          end if;\n"
+  << "        end if;\n"
+  << "      end if;\n\n"
+  << "      -- transmit: copy the next result buffer, release it, and send the copy most significant byte first\n"
+  << "      case tx_state is\n"
+  << "        when TX_IDLE =>\n"
+  << "          if (res_full(tx_sel) = '1') then\n"
+  << "            tx_frame <= res_buf(tx_sel);\n"
+  << "            res_release(tx_sel) <= not res_release(tx_sel);\n"
+  << "            tx_sel <= 1 - tx_sel;\n"
+  << "            tx_state <= TX_LOAD;\n"
+  << "          end if;\n"
+  << "        when TX_LOAD =>\n"
+  << "          tx_data <= tx_frame(g_n + g_m - 1 downto g_n + g_m - 8);\n"
+  << "          tx_frame <= tx_frame(g_n + g_m - 9 downto 0) & x\"00\";\n"
+  << "          tx_state <= TX_SEND;\n"
+  << "        when TX_SEND =>\n"
+  << "          tx_state <= TX_WAIT;\n"
+  << "        when TX_WAIT =>\n"
+  << "          if (tx_ready = '1') then\n"
+  << "            if (tx_count = g_bytes - 1) then\n"
+  << "              tx_count <= 0;\n"
+  << "              tx_state <= TX_IDLE;\n"
+  << "            else\n"
+  << "              tx_count <= tx_count + 1;\n"
+  << "              tx_state <= TX_LOAD;\n"
+  << "            end if;\n"
+  << "          end if;\n"
+  << "      end case;\n"
+  << "    end if;\n"
+  << "  end process;\n\n";
+
+  // The multiplier and its control run on clk_hw
+  output
+  << "  -- Compute (clk_hw)\n"
+  << "  process (clk_hw, reset) begin\n"
+  << "    if (reset = '1') then\n"
+  << "      op_release <= \"00\";\n"
+  << "      res_fill <= \"00\";\n"
+  << "      mul_sel <= 0;\n"
+  << "      mul_state <= MUL_IDLE;\n"
+  << "      products <= (others => '0');\n"
+  << "    elsif (clk_hw'event and clk_hw = '1') then\n"
+  << "      -- multiplier is held in reset while idle, and started once operands and a result buffer are ready\n"
+  << "      case mul_state is\n"
+  << "        when MUL_IDLE =>\n"
+  << "          if (op_full_hw(mul_sel) = '1' and res_full_hw(mul_sel) = '0') then\n"
+  << "            mul_state <= MUL_RUN;\n"
+  << "          end if;\n"
+  << "        when MUL_RUN =>\n"
+  << "          if (mul_done = '1') then\n"
+  << "            res_buf(mul_sel) <= prod;\n"
+  << "            res_fill(mul_sel) <= not res_fill(mul_sel);\n"
+  << "            op_release(mul_sel) <= not op_release(mul_sel);\n"
+  << "            mul_sel <= 1 - mul_sel;\n"
+  << "            products <= products + 1;\n"
+  << "            mul_state <= MUL_IDLE;\n"
+  << "          end if;\n"
+  << "      end case;\n"
+  << "    end if;\n"
+  << "  end process;\n";
+
+  // End Component Logic
+  output << "end;";
+  closeOutput(output, filename);
+}
+
+// Top level for stream_container_N with the same ports, clocking wizard instance and clock
+// relationship as mk8_apex, so the board constraint files in /src/XCVR apply unchanged
+void genStreamApex() {
+  std::ofstream output;
+  std::string entityName = "stream_apex_" + std::to_string(n);
+	std::string filename = entityName + FILE_ENDING;
+  openOutput(output, filename);
+
+  printLibraries(output);
+
+  //
+  // Entity
+  //
+
+  // Begin Entity
+  output << "entity " << entityName << " is" << std::endl;
+
+  // Generics
+  output
+  << "generic(\n"
+  << "  g_clk_freq:        integer := " << CLK_FREQ << ";  -- Board clock\n"
+  << "  g_sampling_factor: integer := " << samplingFactor << ";  -- rx oversampling factor\n"
+  << "  g_baud_rate:       integer := " << baudRate << "\n"
+  << ");\n";
+
+  // Same ports as mk8_apex; the buttons are unused
+  output
+  << "port(\n"
+  << "  clk: in std_logic;\n"
+  << "  reset: in std_logic;\n"
+  << "  btn_up: in std_logic;\n"
+  << "  btn_left: in std_logic;\n"
+  << "  btn_right: in std_logic;\n"
+  << "  btn_down: in std_logic;\n"
+  << "  switches: in std_logic_vector(15 downto 0);\n"
+  << "  input: in std_logic; -- serial in\n"
+  << "  output: out std_logic; -- serial out\n"
+  << "  leds: out std_logic_vector(15 downto 0)\n"
+  << ");\n";
+
+  // End Entity
+  output << "end " << entityName << ";\n\n";
+
+  //
+  // Architecture
+  //
+
+  output << "architecture behavioral of " << entityName << " is\n\n";
+
+  output
+  << "  -- clk_hw comes from the same Clock Wizard IP (clk_wiz_0) as mk8_apex, instantiated as hw_mmcm, so\n"
+  << "  -- the set_clock_groups -asynchronous line of basys3_mk8_apex.xdc / nexys_mk8_apex.xdc covers the\n"
+  << "  -- paths between clk and clk_hw. Re-customize clk_wiz_0 to change the multiplier clock rate.\n\n";
+
+  // Components
+  output
+  << "  component clk_wiz_0\n"
+  << "  port(\n"
+  << "    reset: in std_logic;\n"
+  << "    clk_in1: in std_logic;\n"
+  << "    clk_100mhz: out std_logic;\n"
+  << "    clk_hw: out std_logic;\n"
+  << "    locked: out std_logic\n"
+  << "  );\n"
+  << "  end component;\n\n";
+
+  output
+  << "  component stream_container_" << n << "\n"
+  << "  generic(\n"
+  << "    g_clk_freq: integer;\n"
+  << "    g_sampling_factor: integer;\n"
+  << "    g_baud_rate: integer\n"
+  << "  );\n"
+  << "  port(\n"
+  << "    clk: in std_logic;\n"
+  << "    clk_hw: in std_logic;\n"
+  << "    reset: in std_logic;\n"
+  << "    switches: in std_logic_vector(15 downto 0);\n"
+  << "    input: in std_logic;\n"
+  << "    output: out std_logic;\n"
+  << "    leds: out std_logic_vector(15 downto 0)\n"
+  << "  );\n"
+  << "  end component;\n\n";
+
+  // Signals
+  output
+  << "  signal mmcm_locked: std_logic;\n"
+  << "  signal clk_100mhz: std_logic;\n"
+  << "  signal clk_hw: std_logic;\n"
+  << "  signal clk_hw_buf: std_logic;\n\n";
+
+  // Begin
+  output << "begin\n";
+
+  // Instantiate Components
+  output
+  << "  -- Instantiate Components\n"
+  << "  hw_mmcm: clk_wiz_0 port map(\n"
+  << "    reset => reset,\n"
+  << "    clk_in1 => clk,\n"
+  << "    clk_100mhz => clk_100mhz,\n"
+  << "    clk_hw => clk_hw_buf,\n"
+  << "    locked => mmcm_locked\n"
+  << "  );\n\n"
+  << "  clk_hw <= clk_hw_buf when (mmcm_locked = '1') else '0';\n\n"
+  << "  container: stream_container_" << n << "\n"
+  << "  generic map(\n"
+  << "    g_clk_freq => g_clk_freq,\n"
+  << "    g_sampling_factor => g_sampling_factor,\n"
+  << "    g_baud_rate => g_baud_rate\n"
+  << "  )\n"
+  << "  port map(\n"
+  << "    clk => clk,\n"
+  << "    clk_hw => clk_hw,\n"
+  << "    reset => reset,\n"
+  << "    switches => switches,\n"
+  << "    input => input,\n"
+  << "    output => output,\n"
+  << "    leds => leds\n"
+  << "  );\n";
+
+  // End Component Logic
+  output << "end;";
+  closeOutput(output, filename);
 }
 
 bool isEmpty(std::vector<bool> bv) {
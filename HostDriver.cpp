@@ -0,0 +1,710 @@
+/*
+ * Title: Host Driver and Streaming Postprocessor
+ * Description:
+ *   Native replacement for the Kotlin Output Postprocessor and for manual base conversion.
+ *   Talks to the mk8 serial transceiver (see src/XCVR) using its byte framing: each frame is
+ *   G_total_bits / 8 raw bytes sent most significant byte first, with the multiplier in the
+ *   upper half and the multiplicand in the lower half of the operand frame. The product is
+ *   returned as a frame of the same size. Operand signs are set with the board switches, so
+ *   only magnitudes are sent.
+ *
+ * Copyright: Ohio Northern University, 2023.
+ * License: GPL v3
+ * Usage: HostDriver <command> [options]
+ *   filter [--keep dec|hex|bin]
+ *       Copy stdin to stdout, keeping only digits of the given base and newlines
+ *       (e.g., strips the spaces and commas of terminal or calculator dumps).
+ *   convert --from dec|hex|bin --to dec|hex|bin
+ *       Convert one number per line from stdin to stdout; non-digit characters are ignored.
+ *   run --port <device> [--bits 2048] [--baud 9600] [--stream [--window 3]] [--to dec] [--timeout 10] [operands.txt]
+ *       Send each "mr md" operand pair (stdin if no file is given) to the board and print each
+ *       product on its own line, in order. Operands are unsigned decimal, 0x hex or 0b binary,
+ *       optionally grouped with commas or underscores; signs are set on the board switches.
+ *       The stock mk8 transceiver stops after one product until its reset button is pressed, so
+ *       without --stream exactly one operand pair is accepted per run. With --stream, for the
+ *       generated stream_container_N, any number of pairs is sent while sending, receiving and
+ *       conversion run concurrently; --window sets how many frames may be in flight at once
+ *       (at most STREAM_MAX_WINDOW, which the container's buffers always accept).
+ *   loopback [--bits 2048] [--count 1000] [--stream [--window 3]]
+ *       Self-test: run random operands through a pseudo-terminal whose other end emulates the
+ *       stock transceiver (pressing its reset before every operation) or, with --stream, the
+ *       buffers of stream_container_N, and verify every product.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define DEFAULT_TOTAL_BITS 2048 // matches mk8_apex_2048
+#define DEFAULT_BAUD_RATE 9600  // matches G_baud_rate of the apex component
+#define DEFAULT_TIMEOUT 10      // seconds to wait for a product before giving up
+#define STREAM_BLOCK 65536      // bytes per read when filtering
+#define STREAM_MAX_WINDOW 3     // frames stream_container_N is guaranteed to accept in flight
+#define EMULATED_BAUD_RATE 921600 // link speed of the loopback board, so products queue up as on a real link
+
+// Little-endian array of 64-bit limbs
+typedef std::vector<uint64_t> BigInt;
+
+// Prototypes
+size_t filterDigits(const char *in, size_t length, char *out, int base);
+BigInt parseNumber(const char *digits, size_t length, int base);
+std::string formatNumber(BigInt value, int base);
+void toBytes(const BigInt &value, uint8_t *out, size_t bytes);
+BigInt fromBytes(const uint8_t *in, size_t bytes);
+bool configureSerial(int fd, int baud);
+int runOperands(int fd, const std::vector<std::pair<BigInt, BigInt>> &ops, int totalBits, int window,
+                int timeout, const std::function<void(size_t, const BigInt &)> &onProduct);
+
+//
+// Vectorized Digit Filter
+//
+
+bool isDigitOf(char c, int base) {
+  if (base == 2) return c == '0' || c == '1';
+  if (base == 16) return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+  return c >= '0' && c <= '9';
+}
+
+#if defined(__SSE2__)
+// Mask of bytes within [lo, hi]; bytes >= 0x80 compare as negative and never match
+inline __m128i inRange(__m128i x, char lo, char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8(lo - 1)), _mm_cmplt_epi8(x, _mm_set1_epi8(hi + 1)));
+}
+#endif
+
+// Copy the digits of `base` and newlines from `in` to `out`, returning the number of bytes kept
+size_t filterDigits(const char *in, size_t length, char *out, int base) {
+  size_t i = 0, kept = 0;
+#if defined(__SSE2__)
+  // 16 bytes at a time: whole blocks of digits (the common case) are copied directly,
+  // blocks without any digits are skipped, and mixed blocks are compacted bit by bit.
+  for (; i + 16 <= length; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *) (in + i));
+    __m128i keep = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n')),
+                                inRange(x, '0', base == 2 ? '1' : '9'));
+    if (base == 16)
+      keep = _mm_or_si128(keep, _mm_or_si128(inRange(x, 'a', 'f'), inRange(x, 'A', 'F')));
+    unsigned mask = _mm_movemask_epi8(keep);
+    if (mask == 0xFFFF) {
+      _mm_storeu_si128((__m128i *) (out + kept), x);
+      kept += 16;
+    } else {
+      while (mask != 0) {
+        out[kept++] = in[i + __builtin_ctz(mask)];
+        mask &= mask - 1;
+      }
+    }
+  }
+#endif
+  for (; i < length; i++) {
+    if (in[i] == '\n' || isDigitOf(in[i], base)) out[kept++] = in[i];
+  }
+  return kept;
+}
+
+//
+// Base Conversion
+//
+
+int digitValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return c - 'A' + 10;
+}
+
+// value = value * multiplier + addend
+void multiplyAdd(BigInt &value, uint64_t multiplier, uint64_t addend) {
+  unsigned __int128 carry = addend;
+  for (uint64_t &limb : value) {
+    unsigned __int128 t = (unsigned __int128) limb * multiplier + carry;
+    limb = (uint64_t) t;
+    carry = t >> 64;
+  }
+  if (carry != 0) value.push_back((uint64_t) carry);
+}
+
+// Parse pre-filtered digits. Binary and hex are packed directly into limbs; decimal is
+// consumed 19 digits (one limb) at a time so each step is a single multiply-add pass.
+BigInt parseNumber(const char *digits, size_t length, int base) {
+  BigInt value;
+  if (base == 10) {
+    size_t i = 0;
+    while (i < length) {
+      size_t chunk = std::min<size_t>(19, length - i);
+      uint64_t part = 0, scale = 1;
+      for (size_t j = 0; j < chunk; j++) {
+        part = part * 10 + (digits[i + j] - '0');
+        scale *= 10;
+      }
+      multiplyAdd(value, scale, part);
+      i += chunk;
+    }
+  } else {
+    int bitsPerDigit = base == 16 ? 4 : 1;
+    value.assign((length * bitsPerDigit + 63) / 64, 0);
+    for (size_t i = 0; i < length; i++) {
+      size_t bit = (length - 1 - i) * bitsPerDigit; // position of this digit's least significant bit
+      value[bit / 64] |= (uint64_t) digitValue(digits[i]) << (bit % 64);
+    }
+  }
+  while (!value.empty() && value.back() == 0) value.pop_back();
+  return value;
+}
+
+std::string formatNumber(BigInt value, int base) {
+  while (!value.empty() && value.back() == 0) value.pop_back();
+  if (value.empty()) return "0";
+
+  std::string result;
+  if (base == 10) {
+    // repeatedly divide by 10^19, emitting 19 digits per pass
+    const uint64_t chunk = 10000000000000000000ULL;
+    while (!value.empty()) {
+      unsigned __int128 remainder = 0;
+      for (int i = value.size() - 1; i >= 0; i--) {
+        unsigned __int128 t = (remainder << 64) | value[i];
+        value[i] = (uint64_t) (t / chunk);
+        remainder = t % chunk;
+      }
+      while (!value.empty() && value.back() == 0) value.pop_back();
+      uint64_t part = (uint64_t) remainder;
+      for (int j = 0; j < 19 && (part != 0 || !value.empty()); j++) {
+        result += (char) ('0' + part % 10);
+        part /= 10;
+      }
+    }
+  } else {
+    const char *symbols = "0123456789abcdef";
+    int bitsPerDigit = base == 16 ? 4 : 1;
+    size_t digits = (value.size() * 64 + bitsPerDigit - 1) / bitsPerDigit;
+    for (size_t d = 0; d < digits; d++) {
+      size_t bit = d * bitsPerDigit;
+      result += symbols[(value[bit / 64] >> (bit % 64)) & (base - 1)];
+    }
+    while (result.size() > 1 && result.back() == '0') result.pop_back();
+  }
+  std::reverse(result.begin(), result.end());
+  return result;
+}
+
+// Number of significant bits
+int bitLength(const BigInt &value) {
+  for (int i = value.size() - 1; i >= 0; i--) {
+    if (value[i] != 0) return 64 * i + 64 - __builtin_clzll(value[i]);
+  }
+  return 0;
+}
+
+// Big-endian (most significant byte first, as sent over UART) truncated to `bytes`
+void toBytes(const BigInt &value, uint8_t *out, size_t bytes) {
+  for (size_t i = 0; i < bytes; i++) {
+    size_t limb = i / 8;
+    out[bytes - 1 - i] = limb < value.size() ? (uint8_t) (value[limb] >> (8 * (i % 8))) : 0;
+  }
+}
+
+BigInt fromBytes(const uint8_t *in, size_t bytes) {
+  BigInt value((bytes + 7) / 8, 0);
+  for (size_t i = 0; i < bytes; i++) value[i / 8] |= (uint64_t) in[bytes - 1 - i] << (8 * (i % 8));
+  return value;
+}
+
+// Operand token: unsigned decimal, 0x hex or 0b binary, with commas and underscores as digit
+// grouping. Anything else, including a sign (signs are set on the board switches), is rejected.
+bool parseOperand(const std::string &token, BigInt &value) {
+  int base = 10;
+  size_t start = 0;
+  if (token.size() > 2 && token[0] == '0') {
+    if (token[1] == 'x' || token[1] == 'X') base = 16;
+    else if (token[1] == 'b' || token[1] == 'B') base = 2;
+    if (base != 10) start = 2;
+  }
+  std::vector<char> digits;
+  for (size_t i = start; i < token.size(); i++) {
+    if (isDigitOf(token[i], base)) digits.push_back(token[i]);
+    else if (token[i] != ',' && token[i] != '_') return false;
+  }
+  if (digits.empty()) return false;
+  value = parseNumber(digits.data(), digits.size(), base);
+  return true;
+}
+
+int parseBase(const std::string &name) {
+  if (name == "bin") return 2;
+  if (name == "hex") return 16;
+  if (name == "dec") return 10;
+  return 0;
+}
+
+//
+// Serial I/O
+//
+
+speed_t baudConstant(int baud) {
+  switch (baud) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+#ifdef B460800
+    case 460800: return B460800;
+#endif
+#ifdef B921600
+    case 921600: return B921600;
+#endif
+    default: return 0;
+  }
+}
+
+// Raw 8N1 without flow control, as expected by mk8_rx_module/mk8_tx_module
+bool configureSerial(int fd, int baud) {
+  struct termios tty;
+  speed_t speed = baudConstant(baud);
+  if (speed == 0 || tcgetattr(fd, &tty) != 0) return false;
+  cfmakeraw(&tty);
+  tty.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+  tty.c_cflag |= CS8 | CLOCAL | CREAD;
+  tty.c_cc[VMIN] = 1;
+  tty.c_cc[VTIME] = 0;
+  cfsetispeed(&tty, speed);
+  cfsetospeed(&tty, speed);
+  return tcsetattr(fd, TCSANOW, &tty) == 0;
+}
+
+bool writeFull(int fd, const uint8_t *data, size_t length) {
+  while (length > 0) {
+    ssize_t written = write(fd, data, length);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) return false;
+    data += written;
+    length -= written;
+  }
+  return true;
+}
+
+// Read exactly `length` bytes, waiting at most `timeout` seconds for each chunk (0: forever)
+bool readFull(int fd, uint8_t *data, size_t length, int timeout) {
+  while (length > 0) {
+    if (timeout > 0) {
+      struct pollfd p = {fd, POLLIN, 0};
+      int ready = poll(&p, 1, timeout * 1000);
+      if (ready < 0 && errno == EINTR) continue;
+      if (ready <= 0) return false;
+    }
+    ssize_t got = read(fd, data, length);
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) return false;
+    data += got;
+    length -= got;
+  }
+  return true;
+}
+
+// Send operand frames from a writer thread while this thread receives products, keeping at
+// most `window` frames in flight. Returns the number of products received.
+int runOperands(int fd, const std::vector<std::pair<BigInt, BigInt>> &ops, int totalBits, int window,
+                int timeout, const std::function<void(size_t, const BigInt &)> &onProduct) {
+  size_t frameBytes = totalBits / 8, halfBytes = frameBytes / 2;
+  std::mutex lock;
+  std::condition_variable slotFree;
+  size_t received = 0;
+  bool failed = false;
+
+  std::thread writer([&]() {
+    std::vector<uint8_t> frame(frameBytes);
+    for (size_t i = 0; i < ops.size(); i++) {
+      toBytes(ops[i].first, frame.data(), halfBytes);               // mr: upper half, sent first
+      toBytes(ops[i].second, frame.data() + halfBytes, halfBytes); // md: lower half
+      {
+        std::unique_lock<std::mutex> guard(lock);
+        slotFree.wait(guard, [&]() { return failed || i - received < (size_t) window; });
+        if (failed) return;
+      }
+      if (!writeFull(fd, frame.data(), frameBytes)) {
+        std::lock_guard<std::mutex> guard(lock);
+        failed = true;
+        return;
+      }
+    }
+  });
+
+  std::vector<uint8_t> frame(frameBytes);
+  size_t count = 0;
+  for (; count < ops.size(); count++) {
+    if (!readFull(fd, frame.data(), frameBytes, timeout)) break;
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      received = count + 1;
+      if (failed) break;
+    }
+    slotFree.notify_one();
+    onProduct(count, fromBytes(frame.data(), frameBytes));
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (count < ops.size()) failed = true;
+  }
+  slotFree.notify_one();
+  writer.join();
+  return count;
+}
+
+//
+// Commands
+//
+
+int commandFilter(int base) {
+  std::vector<char> in(STREAM_BLOCK), out(STREAM_BLOCK);
+  size_t got;
+  while ((got = fread(in.data(), 1, in.size(), stdin)) > 0) {
+    size_t kept = filterDigits(in.data(), got, out.data(), base);
+    fwrite(out.data(), 1, kept, stdout);
+  }
+  return 0;
+}
+
+int commandConvert(int from, int to) {
+  std::ios::sync_with_stdio(false);
+  std::string line;
+  std::vector<char> digits;
+  while (std::getline(std::cin, line)) {
+    digits.resize(line.size());
+    size_t length = filterDigits(line.data(), line.size(), digits.data(), from);
+    if (length == 0) continue;
+    std::cout << formatNumber(parseNumber(digits.data(), length, from), to) << '\n';
+  }
+  return 0;
+}
+
+bool readOperands(std::istream &input, const std::string &name, int totalBits,
+                  std::vector<std::pair<BigInt, BigInt>> &ops) {
+  std::string line, mr, md, extra;
+  for (int lineNumber = 1; std::getline(input, line); lineNumber++) {
+    std::stringstream ss(line);
+    if (!(ss >> mr) || mr[0] == '#') continue;
+    if (!(ss >> md) || ss >> extra) {
+      std::cerr << name << ":" << lineNumber << ": expected two operands" << std::endl;
+      return false;
+    }
+    BigInt a, b;
+    for (const std::string *token : {&mr, &md}) {
+      if (!parseOperand(*token, token == &mr ? a : b)) {
+        std::cerr << name << ":" << lineNumber << ": invalid operand '" << *token
+                  << "', expected unsigned decimal, 0x hex or 0b binary" << std::endl;
+        return false;
+      }
+    }
+    if (bitLength(a) > totalBits / 2 || bitLength(b) > totalBits / 2) {
+      std::cerr << name << ":" << lineNumber << ": operand wider than " << totalBits / 2 << " bits" << std::endl;
+      return false;
+    }
+    ops.emplace_back(a, b);
+  }
+  return true;
+}
+
+int commandRun(const std::string &port, const std::string &operandFile, int totalBits, int baud,
+               bool stream, int window, int base, int timeout) {
+  if (baudConstant(baud) == 0) {
+    std::cerr << "Unsupported baud rate " << baud << std::endl;
+    return 2;
+  }
+  std::vector<std::pair<BigInt, BigInt>> ops;
+  bool ok;
+  if (operandFile.empty() || operandFile == "-") ok = readOperands(std::cin, "stdin", totalBits, ops);
+  else {
+    std::ifstream input(operandFile);
+    if (!input) {
+      std::cerr << "Could not open " << operandFile << std::endl;
+      return 1;
+    }
+    ok = readOperands(input, operandFile, totalBits, ops);
+  }
+  if (!ok) return 1;
+  if (!stream && ops.size() > 1) {
+    std::cerr << ops.size() << " operand pairs given, but the stock mk8 transceiver must be reset after every"
+              << " operation. Run one pair at a time, or pass --stream for stream_container_N." << std::endl;
+    return 2;
+  }
+
+  int fd = open(port.c_str(), O_RDWR | O_NOCTTY);
+  if (fd < 0) {
+    std::cerr << "Could not open " << port << ": " << strerror(errno) << std::endl;
+    return 1;
+  }
+  if (!configureSerial(fd, baud)) {
+    std::cerr << "Could not configure " << port << " at " << baud << " baud: " << strerror(errno) << std::endl;
+    close(fd);
+    return 1;
+  }
+  tcflush(fd, TCIOFLUSH);
+
+  std::ios::sync_with_stdio(false);
+  int count = runOperands(fd, ops, totalBits, window, timeout, [&](size_t, const BigInt &prod) {
+    std::cout << formatNumber(prod, base) << '\n';
+  });
+  std::cout.flush();
+  close(fd);
+
+  if (count < (int) ops.size()) {
+    std::cerr << "Received " << count << " of " << ops.size() << " products" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Reference multiplication for the emulated board
+BigInt multiply(const BigInt &a, const BigInt &b) {
+  BigInt prod(a.size() + b.size(), 0);
+  for (size_t i = 0; i < a.size(); i++) {
+    uint64_t carry = 0;
+    for (size_t j = 0; j < b.size(); j++) {
+      unsigned __int128 t = (unsigned __int128) a[i] * b[j] + prod[i + j] + carry;
+      prod[i + j] = (uint64_t) t;
+      carry = (uint64_t) (t >> 64);
+    }
+    prod[i + b.size()] = carry;
+  }
+  return prod;
+}
+
+// Reset button of the emulated board, cleared by the board once it has reset
+std::atomic<bool> resetPressed(false);
+// Set when the emulated stream container drops a byte because both operand buffers are full
+std::atomic<bool> boardOverrun(false);
+
+// Emulate the board on the master side of a pseudo-terminal until the host closes its end.
+// Products are sent at EMULATED_BAUD_RATE, so frames queue up in the board as on a real link.
+// The stock transceiver receives one operand frame, answers it, and ignores its input until
+// reset. The stream container has two operand and two result buffers plus the frame being
+// transmitted, and drops bytes arriving while both operand buffers are full.
+void emulateBoard(int master, int totalBits, bool stream) {
+  size_t frameBytes = totalBits / 8, halfBytes = frameBytes / 2;
+  std::deque<std::vector<uint8_t>> operands, results;
+  std::vector<uint8_t> receiving, sending, in(frameBytes);
+  size_t sent = 0;
+  bool answered = false; // stock transceiver: waiting in TX_DONE for reset
+  auto sendStart = std::chrono::steady_clock::now();
+
+  while (true) {
+    if (resetPressed) {
+      operands.clear();
+      results.clear();
+      receiving.clear();
+      sending.clear();
+      answered = false;
+      resetPressed = false;
+    }
+
+    // compute: multiply as soon as an operand frame and a result buffer are available
+    while (!operands.empty() && results.size() < 2) {
+      const std::vector<uint8_t> &op = operands.front();
+      BigInt prod = multiply(fromBytes(op.data(), halfBytes), fromBytes(op.data() + halfBytes, halfBytes));
+      results.emplace_back(frameBytes);
+      toBytes(prod, results.back().data(), frameBytes);
+      operands.pop_front();
+    }
+
+    // transmit: take the next result, releasing its buffer, and send it at the emulated baud rate
+    if (sending.empty() && !results.empty()) {
+      sending = results.front();
+      results.pop_front();
+      sent = 0;
+      sendStart = std::chrono::steady_clock::now();
+    }
+    if (!sending.empty()) {
+      double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - sendStart).count();
+      size_t due = std::min(frameBytes, (size_t) (elapsed * EMULATED_BAUD_RATE / 10)); // 8N1: 10 bits per byte
+      if (due > sent) {
+        if (!writeFull(master, sending.data() + sent, due - sent)) return;
+        sent = due;
+      }
+      if (sent == frameBytes) sending.clear();
+    }
+
+    // receive whatever has arrived, waiting at most a millisecond so transmission stays paced
+    struct pollfd p = {master, POLLIN, 0};
+    int ready = poll(&p, 1, 1);
+    if (ready < 0 && errno != EINTR) return;
+    if (ready <= 0) continue;
+    ssize_t got = read(master, in.data(), in.size());
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) return; // host closed its end
+    for (ssize_t i = 0; i < got; i++) {
+      if (!stream && answered) continue; // rx is held in reset until the reset button
+      if (stream && operands.size() == 2) {
+        boardOverrun = true;
+        continue;
+      }
+      receiving.push_back(in[i]);
+      if (receiving.size() == frameBytes) {
+        operands.push_back(receiving);
+        receiving.clear();
+        answered = true;
+      }
+    }
+  }
+}
+
+// Press the reset button of the emulated board and wait until it has reset
+void pressReset() {
+  resetPressed = true;
+  while (resetPressed) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+int commandLoopback(int totalBits, int count, bool stream, int window) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    std::cerr << "Could not create pseudo-terminal: " << strerror(errno) << std::endl;
+    if (master >= 0) close(master);
+    return 1;
+  }
+  std::string port = ptsname(master);
+  int fd = open(port.c_str(), O_RDWR | O_NOCTTY);
+  if (fd < 0 || !configureSerial(fd, DEFAULT_BAUD_RATE) || !configureSerial(master, DEFAULT_BAUD_RATE)) {
+    std::cerr << "Could not open " << port << ": " << strerror(errno) << std::endl;
+    if (fd >= 0) close(fd);
+    close(master);
+    return 1;
+  }
+
+  // random operands of every density, including zero and all ones
+  std::mt19937_64 rng(totalBits);
+  size_t limbs = (totalBits / 2 + 63) / 64;
+  std::vector<std::pair<BigInt, BigInt>> ops(count);
+  for (int i = 0; i < count; i++) {
+    for (BigInt *v : {&ops[i].first, &ops[i].second}) {
+      v->resize(limbs);
+      for (uint64_t &limb : *v) limb = i % 4 == 0 ? rng() & rng() : (i % 4 == 1 ? rng() | rng() : rng());
+      if (i == 1) std::fill(v->begin(), v->end(), ~0ULL);
+      if (i == 2) std::fill(v->begin(), v->end(), 0);
+      if ((totalBits / 2) % 64 != 0) v->back() &= (1ULL << ((totalBits / 2) % 64)) - 1;
+    }
+  }
+
+  resetPressed = false;
+  boardOverrun = false;
+  std::thread board(emulateBoard, master, totalBits, stream);
+  int mismatches = 0;
+  auto check = [&](size_t i, const BigInt &prod) {
+    // compare in text form so the check also covers decimal conversion both ways
+    std::string expected = formatNumber(multiply(ops[i].first, ops[i].second), 10);
+    std::string actual = formatNumber(prod, 10);
+    BigInt reparsed = parseNumber(actual.data(), actual.size(), 10);
+    if (actual != expected || formatNumber(reparsed, 16) != formatNumber(prod, 16)) mismatches++;
+  };
+  auto begin = std::chrono::steady_clock::now();
+  int received = 0;
+  if (stream) received = runOperands(fd, ops, totalBits, window, DEFAULT_TIMEOUT, check);
+  else {
+    // the stock transceiver answers once per reset, so press reset before every operation
+    for (; received < count; received++) {
+      pressReset();
+      std::vector<std::pair<BigInt, BigInt>> one(1, ops[received]);
+      auto checkOne = [&](size_t, const BigInt &prod) { check(received, prod); };
+      if (runOperands(fd, one, totalBits, 1, DEFAULT_TIMEOUT, checkOne) != 1) break;
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  close(fd);
+  board.join();
+  close(master);
+
+  std::cout << "Loopback on " << port << " (" << (stream ? "stream container" : "stock transceiver") << "): "
+            << received << "/" << count << " products, " << mismatches << " mismatches, "
+            << received / seconds << " ops/sec" << std::endl;
+  if (boardOverrun) std::cout << "The emulated board dropped input because both operand buffers were full" << std::endl;
+  return (received == count && mismatches == 0 && !boardOverrun) ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " filter|convert|run|loopback [options] (see top of HostDriver.cpp)" << std::endl;
+    return 2;
+  }
+  std::string command = argv[1], port, operandFile;
+  int keep = 10, from = 10, to = 10;
+  int totalBits = DEFAULT_TOTAL_BITS, baud = DEFAULT_BAUD_RATE, window = 0, timeout = DEFAULT_TIMEOUT;
+  int count = 1000;
+  bool stream = false;
+
+  for (int i = 2; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--keep" && hasValue) keep = parseBase(argv[++i]);
+    else if (arg == "--from" && hasValue) from = parseBase(argv[++i]);
+    else if (arg == "--to" && hasValue) to = parseBase(argv[++i]);
+    else if (arg == "--port" && hasValue) port = argv[++i];
+    else if (arg == "--bits" && hasValue) totalBits = atoi(argv[++i]);
+    else if (arg == "--baud" && hasValue) baud = atoi(argv[++i]);
+    else if (arg == "--window" && hasValue) window = std::max(1, atoi(argv[++i]));
+    else if (arg == "--timeout" && hasValue) timeout = atoi(argv[++i]);
+    else if (arg == "--count" && hasValue) count = atoi(argv[++i]);
+    else if (arg == "--stream") stream = true;
+    else if ((arg[0] != '-' || arg == "-") && operandFile.empty()) operandFile = arg;
+    else {
+      std::cerr << "Unknown argument: " << arg << std::endl;
+      return 2;
+    }
+  }
+  if (keep == 0 || from == 0 || to == 0) {
+    std::cerr << "Bases must be one of dec, hex, bin" << std::endl;
+    return 2;
+  }
+  if (totalBits <= 0 || totalBits % 16 != 0) {
+    std::cerr << "--bits must be a positive multiple of 16" << std::endl;
+    return 2;
+  }
+
+  // the stock transceiver handles one frame per reset; the stream container buffers a few
+  if (window == 0) window = stream ? STREAM_MAX_WINDOW : 1;
+  if (!stream && window > 1) {
+    std::cerr << "--window > 1 requires --stream; the stock mk8 transceiver handles one frame per reset" << std::endl;
+    return 2;
+  }
+  if (window > STREAM_MAX_WINDOW) {
+    std::cerr << "stream_container_N accepts at most " << STREAM_MAX_WINDOW << " frames in flight" << std::endl;
+    return 2;
+  }
+
+  if (command == "filter") return commandFilter(keep);
+  if (command == "convert") return commandConvert(from, to);
+  if (command == "loopback") return commandLoopback(totalBits, count, stream, window);
+  if (command == "run") {
+    if (port.empty()) {
+      std::cerr << "run requires --port" << std::endl;
+      return 2;
+    }
+    return commandRun(port, operandFile, totalBits, baud, stream, window, to, timeout);
+  }
+  std::cerr << "Unknown command: " << command << std::endl;
+  return 2;
+}
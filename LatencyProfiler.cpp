@@ -0,0 +1,487 @@
+/*
+ * Title: Operand Workload Latency Profiler
+ * Description:
+ *   Replays a file of real operand pairs through a cycle-level model of the generated
+ *   multiplier_N (see genAlgorithm() in ComponentGenerator.cpp) and its design variants,
+ *   then reports cycle-count histograms, percentiles and predicted throughput.
+ *   The two-level multiplier retires one set bit of the multiplier per cycle, so latency
+ *   depends on the operand data rather than only on n.
+ *
+ * Copyright: Ohio Northern University, 2023.
+ * License: GPL v3
+ * Usage: LatencyProfiler <operands.txt> [options]
+ *   Each line of the operand file holds a multiplier and a multiplicand separated by whitespace,
+ *   in the same order as the transceiver input (mr in the upper half, md in the lower half).
+ *   Operands may be decimal, hex (0x...) or binary (0b...), optionally signed; commas and
+ *   underscores are ignored so digit-grouped dumps can be pasted directly. Lines starting with # are skipped.
+ *
+ *   -n <bits>                 Multiplier/multiplicand length n (default 256).
+ *   --threads <count>         Worker threads (default: hardware concurrency).
+ *   --clock <MHz>             Estimated clock rate of the hardware clock for every variant (default 100).
+ *   --clock <variant>=<MHz>   Override the clock for one variant, e.g. --clock multibit=60, since the
+ *                             recoded and multi-bit datapaths are deeper and usually close timing lower.
+ *                             Accepts a comma-separated list and may be repeated.
+ *   --bits-per-cycle <b>      Set bits retired per cycle by the multi-bit variant (default 2).
+ *   --variants <list>         Comma-separated subset of: baseline,swap,recoded,multibit (default: all).
+ *   --csv <file>              Also write the full histograms as variant,cycles,count.
+ *   --verify                  Check every modelled product against a reference multiplication.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define DEFAULT_N 256
+#define DEFAULT_CLOCK_MHZ 100.0
+#define DEFAULT_BITS_PER_CYCLE 2
+#define HISTOGRAM_ROWS 16 // rows in the terminal histogram; the CSV always has one row per cycle count
+#define HISTOGRAM_WIDTH 50
+
+// Little-endian array of 64-bit limbs
+typedef std::vector<uint64_t> BigInt;
+
+struct OperandPair {
+  BigInt mr; // multiplier, n bits
+  BigInt md; // multiplicand, m = n bits
+};
+
+/*
+Design variants of multiplier_N. Cycle counts are measured from the cycle `start` is sampled
+to the cycle `done` is registered high, matching the generated clock-sensitive process:
+  - one cycle to load mr_reg and clear prod_reg,
+  - one cycle per retired bit of mr_reg (priority encode, shift, add, clear bit),
+  - one cycle for `done <= hw_done` once mr_reg is empty.
+*/
+enum Variant {
+  BASELINE,     // as generated: one set bit of mr retired per cycle
+  OPERAND_SWAP, // one extra cycle compares popcounts and uses the sparser operand as mr
+  RECODED,      // one extra cycle recodes mr into non-adjacent form; each nonzero digit is an add or subtract
+  MULTI_BIT,    // `bitsPerCycle` encoder/shifter lanes retire that many set bits per cycle
+  VARIANT_COUNT
+};
+
+const char *variantNames[VARIANT_COUNT] = {"baseline", "swap", "recoded", "multibit"};
+
+// Prototypes
+bool parseOperand(std::string token, int limbs, BigInt &value);
+int popcount(const BigInt &x);
+int highestSetBit(const BigInt &x);
+void addShifted(BigInt &acc, const BigInt &x, int shift, bool subtract);
+void referenceProduct(const BigInt &mr, const BigInt &md, BigInt &prod);
+int simulate(Variant variant, const OperandPair &ops, BigInt &prod);
+void profileRange(const std::vector<OperandPair> &ops, size_t begin, size_t end,
+                  std::vector<std::vector<uint64_t>> &histograms, uint64_t &mismatches);
+void printReport(const std::vector<std::vector<uint64_t>> &histograms, uint64_t operandCount);
+
+// Parameters
+int n = DEFAULT_N;
+int bitsPerCycle = DEFAULT_BITS_PER_CYCLE;
+double clockMHz[VARIANT_COUNT] = {DEFAULT_CLOCK_MHZ, DEFAULT_CLOCK_MHZ, DEFAULT_CLOCK_MHZ, DEFAULT_CLOCK_MHZ};
+bool verify = false;
+std::vector<Variant> variants;
+
+// Highest cycle count any variant can take, used to size histograms
+int maxCycles() {
+  return n + 4;
+}
+
+//
+// Operand Parsing
+//
+
+// Parse a decimal, 0x hex or 0b binary operand into `limbs` limbs, ignoring sign and digit grouping
+bool parseOperand(std::string token, int limbs, BigInt &value) {
+  value.assign(limbs, 0);
+  if (!token.empty() && (token[0] == '-' || token[0] == '+')) token.erase(0, 1);
+  token.erase(std::remove_if(token.begin(), token.end(),
+                             [](char c) { return c == ',' || c == '_'; }), token.end());
+
+  int base = 10;
+  if (token.size() > 2 && token[0] == '0' && (token[1] == 'x' || token[1] == 'X')) base = 16;
+  else if (token.size() > 2 && token[0] == '0' && (token[1] == 'b' || token[1] == 'B')) base = 2;
+  if (base != 10) token.erase(0, 2);
+  if (token.empty()) return false;
+
+  for (char c : token) {
+    uint64_t digit;
+    if (c >= '0' && c <= '9') digit = c - '0';
+    else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+    else return false;
+    if (digit >= (uint64_t) base) return false;
+
+    // value = value * base + digit, failing on overflow past the operand width
+    unsigned __int128 carry = digit;
+    for (int i = 0; i < limbs; i++) {
+      unsigned __int128 t = (unsigned __int128) value[i] * base + carry;
+      value[i] = (uint64_t) t;
+      carry = t >> 64;
+    }
+    if (carry != 0) return false;
+  }
+  return highestSetBit(value) < n;
+}
+
+//
+// Big Integer Helpers
+//
+
+int popcount(const BigInt &x) {
+  int count = 0;
+  for (uint64_t limb : x) count += __builtin_popcountll(limb);
+  return count;
+}
+
+// Index of the most significant set bit, or -1 if x is zero (i.e., the priority encoder)
+int highestSetBit(const BigInt &x) {
+  for (int i = x.size() - 1; i >= 0; i--) {
+    if (x[i] != 0) return 64 * i + 63 - __builtin_clzll(x[i]);
+  }
+  return -1;
+}
+
+void clearBit(BigInt &x, int bit) {
+  x[bit / 64] &= ~(1ULL << (bit % 64));
+}
+
+// acc += x << shift (or -=), modulo 2^(64 * acc.size()) (i.e., barrel shifter and CLA)
+void addShifted(BigInt &acc, const BigInt &x, int shift, bool subtract) {
+  int limbShift = shift / 64, bitShift = shift % 64;
+  uint64_t carry = subtract ? 1 : 0; // two's complement: acc + ~(x << shift) + 1
+  uint64_t prev = 0;
+  for (size_t i = 0; i < acc.size(); i++) {
+    // limb i of (x << shift)
+    uint64_t word = 0;
+    int j = (int) i - limbShift;
+    if (j >= 0 && j < (int) x.size()) word = x[j] << bitShift;
+    if (bitShift != 0 && j - 1 >= 0 && j - 1 < (int) x.size()) word |= prev >> (64 - bitShift);
+    prev = (j >= 0 && j < (int) x.size()) ? x[j] : 0;
+
+    if (subtract) word = ~word;
+    unsigned __int128 t = (unsigned __int128) acc[i] + word + carry;
+    acc[i] = (uint64_t) t;
+    carry = (uint64_t) (t >> 64);
+  }
+}
+
+// Schoolbook multiplication, used only to check the model with --verify
+void referenceProduct(const BigInt &mr, const BigInt &md, BigInt &prod) {
+  prod.assign(mr.size() + md.size(), 0);
+  for (size_t i = 0; i < mr.size(); i++) {
+    uint64_t carry = 0;
+    for (size_t j = 0; j < md.size(); j++) {
+      unsigned __int128 t = (unsigned __int128) mr[i] * md[j] + prod[i + j] + carry;
+      prod[i + j] = (uint64_t) t;
+      carry = (uint64_t) (t >> 64);
+    }
+    prod[i + md.size()] = carry;
+  }
+}
+
+//
+// Multiplier Model
+//
+
+// Run one multiplication through the given variant, returning its latency in cycles
+int simulate(Variant variant, const OperandPair &ops, BigInt &prod) {
+  const BigInt *mr = &ops.mr, *md = &ops.md;
+  int cycles = 2; // load cycle + registered done
+  prod.assign(mr->size() + md->size(), 0);
+
+  switch (variant) {
+    case OPERAND_SWAP:
+      cycles++; // popcount comparison is registered before loading
+      if (popcount(ops.md) < popcount(ops.mr)) std::swap(mr, md);
+      [[fallthrough]]; // the selected operands run through the baseline datapath
+    case BASELINE: {
+      BigInt mr_reg = *mr;
+      for (int bit = highestSetBit(mr_reg); bit >= 0; bit = highestSetBit(mr_reg)) {
+        addShifted(prod, *md, bit, false);
+        clearBit(mr_reg, bit);
+        cycles++;
+      }
+      break;
+    }
+    case RECODED: {
+      cycles++; // recoding is registered before loading
+      // non-adjacent form: positive digits in `plus`, negative digits in `minus`
+      BigInt half = *mr, triple = *mr;
+      half.push_back(0);
+      triple.push_back(0);
+      for (size_t i = 0; i < half.size(); i++)
+        half[i] = (half[i] >> 1) | (i + 1 < half.size() ? half[i + 1] << 63 : 0);
+      addShifted(triple, half, 0, false);
+      BigInt plus(triple.size()), minus(triple.size());
+      for (size_t i = 0; i < triple.size(); i++) {
+        uint64_t changed = half[i] ^ triple[i];
+        plus[i] = triple[i] & changed;
+        minus[i] = half[i] & changed;
+      }
+      while (true) {
+        int p = highestSetBit(plus), m = highestSetBit(minus);
+        if (p < 0 && m < 0) break;
+        if (p > m) {
+          addShifted(prod, *md, p, false);
+          clearBit(plus, p);
+        } else {
+          addShifted(prod, *md, m, true);
+          clearBit(minus, m);
+        }
+        cycles++;
+      }
+      break;
+    }
+    case MULTI_BIT: {
+      BigInt mr_reg = *mr;
+      while (highestSetBit(mr_reg) >= 0) {
+        for (int lane = 0; lane < bitsPerCycle; lane++) {
+          int bit = highestSetBit(mr_reg);
+          if (bit < 0) break;
+          addShifted(prod, *md, bit, false);
+          clearBit(mr_reg, bit);
+        }
+        cycles++;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  return cycles;
+}
+
+// Worker thread: simulate ops[begin, end) through every selected variant
+void profileRange(const std::vector<OperandPair> &ops, size_t begin, size_t end,
+                  std::vector<std::vector<uint64_t>> &histograms, uint64_t &mismatches) {
+  BigInt prod, expected;
+  for (size_t i = begin; i < end; i++) {
+    if (verify) referenceProduct(ops[i].mr, ops[i].md, expected);
+    for (Variant v : variants) {
+      int cycles = simulate(v, ops[i], prod);
+      histograms[v][cycles]++;
+      if (verify && prod != expected) mismatches++;
+    }
+  }
+}
+
+//
+// Reporting
+//
+
+// Smallest cycle count c such that at least `fraction` of operations finish within c cycles
+int percentile(const std::vector<uint64_t> &histogram, uint64_t total, double fraction) {
+  uint64_t target = (uint64_t) std::ceil(fraction * total), seen = 0;
+  for (size_t c = 0; c < histogram.size(); c++) {
+    seen += histogram[c];
+    if (seen >= target && seen > 0) return c;
+  }
+  return histogram.size() - 1;
+}
+
+void printHistogram(const std::vector<uint64_t> &histogram) {
+  int lo = 0, hi = histogram.size() - 1;
+  while (lo < hi && histogram[lo] == 0) lo++;
+  while (hi > lo && histogram[hi] == 0) hi--;
+
+  int width = std::max(1, (hi - lo + HISTOGRAM_ROWS) / HISTOGRAM_ROWS);
+  std::vector<uint64_t> rows;
+  for (int c = lo; c <= hi; c += width) {
+    uint64_t count = 0;
+    for (int j = c; j < c + width && j <= hi; j++) count += histogram[j];
+    rows.push_back(count);
+  }
+  uint64_t peak = *std::max_element(rows.begin(), rows.end());
+  for (size_t r = 0; r < rows.size(); r++) {
+    int first = lo + r * width, last = std::min(first + width - 1, hi);
+    std::cout << "  " << std::setw(6) << first << " - " << std::setw(6) << last << " | "
+              << std::string(peak ? rows[r] * HISTOGRAM_WIDTH / peak : 0, '#')
+              << " " << rows[r] << std::endl;
+  }
+}
+
+void printReport(const std::vector<std::vector<uint64_t>> &histograms, uint64_t operandCount) {
+  bool sameClock = true;
+  for (Variant v : variants) sameClock = sameClock && clockMHz[v] == clockMHz[variants[0]];
+  std::cout << "Operand pairs: " << operandCount << ", n = " << n << std::endl;
+  if (sameClock)
+    std::cout << "All variants assume the same " << clockMHz[variants[0]] << " MHz clock; "
+              << "use --clock <variant>=<MHz> for variants that close timing lower" << std::endl;
+  std::cout << std::endl;
+
+  std::cout << std::left << std::setw(10) << "variant" << std::right
+            << std::setw(8) << "MHz" << std::setw(10) << "mean" << std::setw(8) << "p50" << std::setw(8) << "p90"
+            << std::setw(8) << "p99" << std::setw(8) << "p99.9" << std::setw(8) << "max"
+            << std::setw(16) << "ops/sec" << std::endl;
+
+  for (Variant v : variants) {
+    const std::vector<uint64_t> &h = histograms[v];
+    double sum = 0;
+    for (size_t c = 0; c < h.size(); c++) sum += (double) c * h[c];
+    double mean = sum / operandCount;
+    std::cout << std::left << std::setw(10) << variantNames[v] << std::right
+              << std::setw(8) << std::fixed << std::setprecision(1) << clockMHz[v]
+              << std::setw(10) << std::setprecision(2) << mean
+              << std::setw(8) << percentile(h, operandCount, 0.5)
+              << std::setw(8) << percentile(h, operandCount, 0.9)
+              << std::setw(8) << percentile(h, operandCount, 0.99)
+              << std::setw(8) << percentile(h, operandCount, 0.999)
+              << std::setw(8) << percentile(h, operandCount, 1.0)
+              << std::setw(16) << std::setprecision(0) << clockMHz[v] * 1e6 / mean << std::endl;
+  }
+
+  for (Variant v : variants) {
+    std::cout << std::endl << variantNames[v] << " cycles:" << std::endl;
+    printHistogram(histograms[v]);
+  }
+}
+
+void writeCsv(const std::string &filename, const std::vector<std::vector<uint64_t>> &histograms) {
+  std::ofstream csv(filename);
+  csv << "variant,cycles,count\n";
+  for (Variant v : variants) {
+    for (size_t c = 0; c < histograms[v].size(); c++) {
+      if (histograms[v][c] > 0) csv << variantNames[v] << "," << c << "," << histograms[v][c] << "\n";
+    }
+  }
+  std::cout << "Wrote " << filename << std::endl;
+}
+
+bool parseVariants(const std::string &list) {
+  variants.clear();
+  std::stringstream ss(list);
+  std::string name;
+  while (std::getline(ss, name, ',')) {
+    int v = 0;
+    while (v < VARIANT_COUNT && name != variantNames[v]) v++;
+    if (v == VARIANT_COUNT) return false;
+    variants.push_back((Variant) v);
+  }
+  return !variants.empty();
+}
+
+// Parse "<MHz>" for every variant, or a comma-separated list of "<variant>=<MHz>"
+bool parseClock(const std::string &list) {
+  char *end;
+  double mhz = strtod(list.c_str(), &end);
+  if (!list.empty() && *end == '\0') {
+    if (mhz <= 0) return false;
+    for (int v = 0; v < VARIANT_COUNT; v++) clockMHz[v] = mhz;
+    return true;
+  }
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    size_t eq = item.find('=');
+    if (eq == std::string::npos) return false;
+    int v = 0;
+    while (v < VARIANT_COUNT && item.substr(0, eq) != variantNames[v]) v++;
+    if (v == VARIANT_COUNT) return false;
+    mhz = strtod(item.c_str() + eq + 1, &end);
+    if (eq + 1 == item.size() || *end != '\0' || mhz <= 0) return false;
+    clockMHz[v] = mhz;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  std::string operandFile, csvFile;
+  int threads = std::max(1u, std::thread::hardware_concurrency());
+  parseVariants("baseline,swap,recoded,multibit");
+
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "-n") == 0 && hasValue) n = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--threads") == 0 && hasValue) threads = std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--bits-per-cycle") == 0 && hasValue) bitsPerCycle = std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--csv") == 0 && hasValue) csvFile = argv[++i];
+    else if (strcmp(argv[i], "--verify") == 0) verify = true;
+    else if (strcmp(argv[i], "--variants") == 0 && hasValue) {
+      if (!parseVariants(argv[++i])) {
+        std::cerr << "Unknown variant in " << argv[i] << std::endl;
+        return 2;
+      }
+    }
+    else if (strcmp(argv[i], "--clock") == 0 && hasValue) {
+      if (!parseClock(argv[++i])) {
+        std::cerr << "Invalid clock " << argv[i] << ", expected <MHz> or <variant>=<MHz>" << std::endl;
+        return 2;
+      }
+    }
+    else if (argv[i][0] != '-' && operandFile.empty()) operandFile = argv[i];
+    else {
+      std::cerr << "Unknown argument: " << argv[i] << std::endl;
+      return 2;
+    }
+  }
+
+  if (operandFile.empty() || n <= 0) {
+    std::cerr << "Usage: " << argv[0] << " <operands.txt> [-n bits] [--threads count] [--clock [variant=]MHz]"
+              << " [--bits-per-cycle b] [--variants list] [--csv file] [--verify]" << std::endl;
+    return 2;
+  }
+
+  std::ifstream input(operandFile);
+  if (!input) {
+    std::cerr << "Could not open " << operandFile << std::endl;
+    return 1;
+  }
+
+  // Read operand pairs
+  int limbs = (n + 63) / 64;
+  std::vector<OperandPair> ops;
+  std::string line, mrToken, mdToken;
+  for (int lineNumber = 1; std::getline(input, line); lineNumber++) {
+    std::stringstream ss(line);
+    if (!(ss >> mrToken) || mrToken[0] == '#') continue;
+    OperandPair pair;
+    if (!(ss >> mdToken) || !parseOperand(mrToken, limbs, pair.mr) || !parseOperand(mdToken, limbs, pair.md)) {
+      std::cerr << operandFile << ":" << lineNumber << ": expected two operands of at most "
+                << n << " bits" << std::endl;
+      return 1;
+    }
+    ops.push_back(std::move(pair));
+  }
+  if (ops.empty()) {
+    std::cerr << "No operand pairs in " << operandFile << std::endl;
+    return 1;
+  }
+
+  // Replay the workload, one contiguous slice and private histograms per thread
+  threads = std::min<size_t>(threads, ops.size());
+  std::vector<std::vector<std::vector<uint64_t>>> threadHistograms(
+    threads, std::vector<std::vector<uint64_t>>(VARIANT_COUNT, std::vector<uint64_t>(maxCycles() + 1, 0)));
+  std::vector<uint64_t> threadMismatches(threads, 0);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    size_t begin = ops.size() * t / threads, end = ops.size() * (t + 1) / threads;
+    workers.emplace_back(profileRange, std::cref(ops), begin, end,
+                         std::ref(threadHistograms[t]), std::ref(threadMismatches[t]));
+  }
+  for (std::thread &w : workers) w.join();
+
+  std::vector<std::vector<uint64_t>> histograms = threadHistograms[0];
+  uint64_t mismatches = threadMismatches[0];
+  for (int t = 1; t < threads; t++) {
+    mismatches += threadMismatches[t];
+    for (int v = 0; v < VARIANT_COUNT; v++)
+      for (size_t c = 0; c < histograms[v].size(); c++) histograms[v][c] += threadHistograms[t][v][c];
+  }
+
+  printReport(histograms, ops.size());
+  if (!csvFile.empty()) writeCsv(csvFile, histograms);
+  if (verify) {
+    std::cout << (mismatches == 0 ? "All modelled products match the reference"
+                                  : "Product mismatches: " + std::to_string(mismatches)) << std::endl;
+    if (mismatches > 0) return 1;
+  }
+  return 0;
+}